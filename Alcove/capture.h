@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tightly packed 8-bit RGBA pixels
+struct CapturedImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+struct ImageDiff {
+    uint64_t mismatchedPixels = 0;
+    uint32_t maxChannelDelta = 0;
+};
+
+// Copies an R8G8B8A8 color image into a persistently mapped staging buffer.
+// The copy is submitted without waiting and tracked by a fence; wait() collects it.
+class FrameCapture {
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily,
+        VkExtent2D extent, VkFormat format);
+    void cleanup();
+
+    // Records and submits a copy of `image`, which is in `oldLayout` and is left in `newLayout`.
+    // Returns false while the previous copy has not been collected.
+    bool capture(VkQueue queue, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout);
+
+    // Blocks until the submitted copy has completed and returns its pixels
+    CapturedImage wait();
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void* mapped = nullptr;
+    VkFence fence = VK_NULL_HANDLE;
+    VkExtent2D extent{};
+    bool coherent = true;
+    bool inFlight = false;
+};
+
+// Returns a memory type with all of `properties`, picking one that also has `preferred` when available
+uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter,
+    VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferred = 0);
+
+void writePng(const std::string& filename, const CapturedImage& image);
+CapturedImage readPng(const std::string& filename);
+
+// Counts pixels whose channels differ by more than `tolerance`
+ImageDiff compareImages(const CapturedImage& actual, const CapturedImage& expected, uint32_t tolerance);
@@ -0,0 +1,50 @@
+@echo off
+rem Renders every scene offscreen under lavapipe and compares it against goldens\<scene>.png.
+rem   run_goldens.bat [path\to\Alcove.exe] [update]
+rem "update" re-records the golden images instead of comparing against them.
+setlocal enabledelayedexpansion
+
+set ALCOVE_EXE=%~1
+if "%ALCOVE_EXE%"=="" set ALCOVE_EXE=%~dp0..\..\x64\Release\Alcove.exe
+set MODE=%~2
+
+if not exist "%ALCOVE_EXE%" (
+    echo Alcove executable not found: %ALCOVE_EXE%
+    exit /b 1
+)
+
+rem Forces Mesa's lavapipe software rasterizer so results do not depend on the GPU
+if "%LAVAPIPE_ICD%"=="" set LAVAPIPE_ICD=C:\Libraries\mesa\x64\lvp_icd.x86_64.json
+if not exist "%LAVAPIPE_ICD%" (
+    echo lavapipe ICD not found: %LAVAPIPE_ICD%
+    exit /b 1
+)
+set VK_ICD_FILENAMES=%LAVAPIPE_ICD%
+set VK_DRIVER_FILES=%LAVAPIPE_ICD%
+
+rem shaders\*.spv are resolved relative to the project directory
+cd /d "%~dp0.."
+
+set FAILED=0
+set SCENES=0
+for /f "usebackq" %%s in (`"%ALCOVE_EXE%" --list-scenes`) do (
+    set /a SCENES+=1
+    if /i "%MODE%"=="update" (
+        "%ALCOVE_EXE%" --scene %%s --capture goldens\%%s.png
+    ) else (
+        "%ALCOVE_EXE%" --scene %%s --golden goldens\%%s.png --tolerance 2 --max-mismatch 64
+    )
+    if errorlevel 1 (
+        echo FAILED: %%s
+        set FAILED=1
+    ) else (
+        echo passed: %%s
+    )
+)
+
+if %SCENES%==0 (
+    echo no scenes were listed
+    exit /b 1
+)
+
+exit /b %FAILED%
@@ -21,8 +21,13 @@
 #include <limits> // Necessary for std::numeric_limits
 #include <algorithm> // Necessary for std::clamp
 #include <fstream>
+#include <chrono>
+#include <future>
+#include <cerrno>
+#include <cctype>
 
 #include "util.h"
+#include "capture.h"
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
@@ -36,12 +41,38 @@ const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// A scene is a shader pair drawn with a fixed vertex count.
+// goldens/run_goldens.bat compares every scene against goldens/<name>.png.
+struct Scene {
+    const char* name;
+    const char* vertShader;
+    const char* fragShader;
+    uint32_t vertexCount;
+};
+
+const std::vector<Scene> scenes = {
+    { "triangle", "shaders/vert.spv", "shaders/frag.spv", 3 },
+};
+
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
 #else
 const bool enableValidationLayers = true;
 #endif
 
+// set by -v/--verbose; gates the extension/layer dumps
+static bool verbose = false;
+
+// set by --capture/--golden/--tolerance/--max-mismatch; renders one frame offscreen without a window, then exits
+static bool captureMode = false;
+static std::string capturePath;
+static std::string goldenPath;
+static uint32_t captureTolerance = 2;
+static uint64_t captureMaxMismatch = 0;
+
+// set by --scene
+static const Scene* activeScene = &scenes[0];
+
 static std::vector<char> readFile(const std::string& filename) {
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
@@ -88,34 +119,80 @@ void DestroyDebugUtilsMessengerEXT(
 
 class HelloTriangleApplication {
 public:
-    void run() {
-        initWindow();
+    int run() {
+        startTime = Clock::now();
+
+        // shader loading does not depend on the window or the device, so it overlaps with both
+        shaderCode = std::async(std::launch::async, [this] {
+            auto begin = Clock::now();
+            auto code = std::make_pair(readFile(activeScene->vertShader), readFile(activeScene->fragShader));
+            std::chrono::duration<double, std::milli> elapsed = Clock::now() - begin;
+            shaderLoadTime = elapsed.count();
+            return code;
+        });
+
+        if (!captureMode) {
+            timePhase("initWindow", [this] { initWindow(); });
+        }
         initVulkan();
-        mainLoop();
+        reportPhaseTimes();
+
+        bool passed = true;
+        if (captureMode) {
+            passed = captureFrame();
+        }
+        else {
+            mainLoop();
+        }
+
         cleanup();
+
+        return passed ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
 private:
-    GLFWwindow* window;
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point startTime;
+    std::vector<std::pair<const char*, double>> phaseTimes;
+    std::future<std::pair<std::vector<char>, std::vector<char>>> shaderCode;
+    std::pair<std::vector<char>, std::vector<char>> shaderBinaries;
+    double shaderLoadTime = 0.0; // written by the loader task, read after shaderCode.get()
+
+    GLFWwindow* window = nullptr;
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkDevice device;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> swapChainImages;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
     std::vector<VkImageView> swapChainImageViews;
+    std::vector<VkFramebuffer> swapChainFramebuffers;
+    VkRenderPass renderPass;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline graphicsPipeline;
+    VkCommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+    VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+    VkFence inFlightFence = VK_NULL_HANDLE;
+
+    // stands in for the swap chain in capture mode
+    VkImage offscreenImage = VK_NULL_HANDLE;
+    VkDeviceMemory offscreenImageMemory = VK_NULL_HANDLE;
+    FrameCapture frameCapture;
 
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
 
-        bool isComplete() {
-            return graphicsFamily.has_value() && presentFamily.has_value();
+        bool isComplete(bool requirePresent) {
+            return graphicsFamily.has_value() && (!requirePresent || presentFamily.has_value());
         }
     };
 
@@ -125,6 +202,35 @@ private:
         std::vector<VkPresentModeKHR> presentModes;
     };
 
+    // cached for the selected physical device by pickPhysicalDevice()
+    QueueFamilyIndices queueFamilyIndices;
+    SwapChainSupportDetails swapChainSupport;
+
+    template<typename F>
+    void timePhase(const char* name, F&& phase) {
+        auto begin = Clock::now();
+        phase();
+        std::chrono::duration<double, std::milli> elapsed = Clock::now() - begin;
+        phaseTimes.emplace_back(name, elapsed.count());
+    }
+
+    void reportPhaseTimes() {
+        double total = 0.0;
+        std::cout << "startup phases:" << '\n';
+        for (const auto& [name, ms] : phaseTimes) {
+            std::cout << '\t' << name << ": " << ms << " ms" << '\n';
+            total += ms;
+        }
+        std::cout << '\t' << "total: " << total << " ms" << '\n';
+        // runs alongside the phases above, so it is not part of the total
+        std::cout << '\t' << "loadShaders (async): " << shaderLoadTime << " ms" << std::endl;
+    }
+
+    void reportFirstFrame() {
+        std::chrono::duration<double, std::milli> elapsed = Clock::now() - startTime;
+        std::cout << "start to first frame: " << elapsed.count() << " ms" << std::endl;
+    }
+
     void initWindow() {
         glfwInit();
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -146,7 +252,10 @@ private:
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
         createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-        createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+        createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+        if (verbose) {
+            createInfo.messageSeverity |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+        }
         createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
         createInfo.pfnUserCallback = debugCallback;
     }
@@ -167,49 +276,54 @@ private:
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
         createInfo.pApplicationInfo = &appInfo;
 
+        // enables only what the window system and the debug messenger need
+        std::vector<const char*> extensionNames;
+
         // GLFW Extensions
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-        std::cout << "GLFW required instance extensions(" << glfwExtensionCount << "): " << '\n';
-        if (glfwExtensions == nullptr) {
-            std::cout << '\t' << "no available extensions" << '\n';
-            if (glfwVulkanSupported() != VK_TRUE) {
-                std::cout << '\t' << "vulkan is not available" << '\n';
-            }
-            else {
-                std::cout << '\t' << "vulkan is minimally available" << '\n';
+        if (!captureMode) {
+            uint32_t glfwExtensionCount = 0;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+            if (glfwExtensions == nullptr) {
+                if (glfwVulkanSupported() != VK_TRUE) {
+                    throw std::runtime_error("vulkan is not available!");
+                }
+                throw std::runtime_error("no GLFW required instance extensions available!");
             }
-        } else {
-            for (int i = 0; i < glfwExtensionCount; i++) {
-                std::cout << '\t' << glfwExtensions[i] << '\n';
+
+            if (verbose) {
+                std::cout << "GLFW required instance extensions(" << glfwExtensionCount << "): " << '\n';
+                for (uint32_t i = 0; i < glfwExtensionCount; i++) {
+                    std::cout << '\t' << glfwExtensions[i] << '\n';
+                }
+                std::cout << std::endl;
             }
+
+            extensionNames.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
         }
-        std::cout << std::endl;
 
-        // Vulcan Extension Support
-        uint32_t extensionCount = 0;
-        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+        if (verbose) {
+            // Vulcan Extension Support
+            uint32_t extensionCount = 0;
+            vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
 
-        std::vector<VkExtensionProperties> extensions(extensionCount);
-        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+            std::vector<VkExtensionProperties> extensions(extensionCount);
+            vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
 
-        std::cout << "available extensions(" << extensionCount << "): " << '\n';
-        for (const auto& extension : extensions) {
-            std::cout << '\t' << extension.extensionName << '\n';
+            std::cout << "available extensions(" << extensionCount << "): " << '\n';
+            for (const auto& extension : extensions) {
+                std::cout << '\t' << extension.extensionName << '\n';
+            }
+            std::cout << std::endl;
         }
-        std::cout << std::endl;
 
-        char** extensionNames = new char* [extensionCount];
-        for (size_t i = 0; i < extensionCount; i++) {
-            char* e = new char[CHAR_SIZE];
-            strcpy_s(e, CHAR_SIZE, extensions[i].extensionName);
-            extensionNames[i] = e;
+        if (enableValidationLayers) {
+            extensionNames.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         }
 
-        createInfo.enabledExtensionCount = extensionCount;
-        createInfo.ppEnabledExtensionNames = extensionNames;
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensionNames.size());
+        createInfo.ppEnabledExtensionNames = extensionNames.data();
         
         // Validation Layer Support
         if (enableValidationLayers && !checkValidationLayerSupport()) {
@@ -245,11 +359,13 @@ private:
         std::vector<VkLayerProperties> availableLayers(layerCount);
         vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
 
-        std::cout << "available validation layers(" << layerCount << "): " << '\n';
-        for (const auto& layerProperties : availableLayers) {
-            std::cout << '\t' << layerProperties.layerName << '\n';
+        if (verbose) {
+            std::cout << "available validation layers(" << layerCount << "): " << '\n';
+            for (const auto& layerProperties : availableLayers) {
+                std::cout << '\t' << layerProperties.layerName << '\n';
+            }
+            std::cout << std::endl;
         }
-        std::cout << std::endl;
 
         for (const char* layerName : validationLayers) {
             bool layerFound = false;
@@ -305,14 +421,17 @@ private:
             }
 
             // Checks Presentation Support
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-            if (presentSupport) {
-                indices.presentFamily = i;
+            if (!captureMode) {
+                VkBool32 presentSupport = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+                if (presentSupport) {
+                    indices.presentFamily = i;
+                }
             }
 
             // Validation Completed
-            if (indices.isComplete()) {
+            // offscreen capture never presents
+            if (indices.isComplete(!captureMode)) {
                 break;
             }
 
@@ -364,29 +483,37 @@ private:
         return details;
     }
 
-    bool isDeviceSuitable(VkPhysicalDevice device) {
+    bool isDeviceSuitable(VkPhysicalDevice device, bool allowCpu) {
         VkPhysicalDeviceProperties deviceProperties;
         vkGetPhysicalDeviceProperties(device, &deviceProperties);
 
-        VkPhysicalDeviceFeatures deviceFeatures;
-        vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
-        
+        if (deviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU &&
+            deviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
+            !(allowCpu && deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU)) {
+            return false;
+        }
+
         QueueFamilyIndices indices = findQueueFamilies(device);
+        if (!indices.isComplete(!captureMode)) {
+            return false;
+        }
+
+        // keeps the queries so device and swap chain creation do not repeat them
+        if (!captureMode) {
+            if (!checkDeviceExtensionSupport(device)) {
+                return false;
+            }
 
-        bool extensionsSupported = checkDeviceExtensionSupport(device);
+            SwapChainSupportDetails details = querySwapChainSupport(device);
+            if (details.formats.empty() || details.presentModes.empty()) {
+                return false;
+            }
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
-            SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
-            swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+            swapChainSupport = std::move(details);
         }
 
-        return 
-            (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ||
-            deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) && 
-            indices.isComplete() &&
-            extensionsSupported &&
-            swapChainAdequate;
+        queueFamilyIndices = indices;
+        return true;
         /* ex)
         return
             deviceproperties.devicetype == vk_physical_device_type_discrete_gpu &&
@@ -405,23 +532,36 @@ private:
         vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
         for (const auto& device : devices) {
-            if (isDeviceSuitable(device)) {
+            if (isDeviceSuitable(device, false)) {
                 physicalDevice = device;
                 break;
             }
         }
 
+        // falls back to software rasterizers such as lavapipe
+        if (physicalDevice == VK_NULL_HANDLE) {
+            for (const auto& device : devices) {
+                if (isDeviceSuitable(device, true)) {
+                    physicalDevice = device;
+                    break;
+                }
+            }
+        }
+
         if (physicalDevice == VK_NULL_HANDLE) {
             throw std::runtime_error("failed to find a suitable GPU!");
         }
     }
 
     void createLogicalDevice() {
-        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        const QueueFamilyIndices& indices = queueFamilyIndices;
 
         // Specifies Queue Creation
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value() };
+        if (!captureMode) {
+            uniqueQueueFamilies.insert(indices.presentFamily.value());
+        }
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -445,8 +585,10 @@ private:
         createInfo.pEnabledFeatures = &deviceFeatures;
 
         // enables the swapchain extension of the device
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        if (!captureMode) {
+            createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+            createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        }
 
         if (enableValidationLayers) {
             createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -463,7 +605,9 @@ private:
 
         // Retrieves Queue Handles
         vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
-        vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        if (!captureMode) {
+            vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        }
     }
 
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
@@ -507,8 +651,6 @@ private:
     }
 
     void createSwapChain() {
-        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
-
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
         VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
         VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
@@ -534,13 +676,13 @@ private:
         createInfo.imageArrayLayers = 1;
         createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
-        uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+        const QueueFamilyIndices& indices = queueFamilyIndices;
+        uint32_t familyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
 
         if (indices.graphicsFamily != indices.presentFamily) {
             createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
             createInfo.queueFamilyIndexCount = 2;
-            createInfo.pQueueFamilyIndices = queueFamilyIndices;
+            createInfo.pQueueFamilyIndices = familyIndices;
         }
         else {
             createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -571,6 +713,50 @@ private:
         swapChainExtent = extent;
     }
 
+    void createOffscreenTarget() {
+        swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+        swapChainExtent = { WIDTH, HEIGHT };
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = swapChainImageFormat;
+        imageInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkResult result = vkCreateImage(device, &imageInfo, nullptr, &offscreenImage);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device, offscreenImage, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        result = vkAllocateMemory(device, &allocInfo, nullptr, &offscreenImageMemory);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate offscreen image memory!");
+        }
+
+        result = vkBindImageMemory(device, offscreenImage, offscreenImageMemory, 0);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind offscreen image memory!");
+        }
+
+        // the rest of the render path treats it as a single-image swap chain
+        swapChainImages = { offscreenImage };
+    }
+
     void createImageViews() {
         swapChainImageViews.resize(swapChainImages.size());
 
@@ -600,6 +786,50 @@ private:
         }
     }
 
+    void createRenderPass() {
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = swapChainImageFormat;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // frame capture transitions the offscreen image for its copy
+        colorAttachment.finalLayout = captureMode ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        VkAttachmentReference colorAttachmentRef{};
+        colorAttachmentRef.attachment = 0;
+        colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+
+        VkSubpassDependency dependency{};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstSubpass = 0;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.srcAccessMask = 0;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = 1;
+        renderPassInfo.pAttachments = &colorAttachment;
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &dependency;
+
+        VkResult result = vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create render pass!");
+        }
+    }
+
     VkShaderModule createShaderModule(const std::vector<char>& code) {
         VkShaderModuleCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -616,8 +846,7 @@ private:
     }
 
     void createGraphicsPipeline() {
-        auto vertShaderCode = readFile("shaders/vert.spv");
-        auto fragShaderCode = readFile("shaders/frag.spv");
+        const auto& [vertShaderCode, fragShaderCode] = shaderBinaries;
 
         VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
         VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
@@ -636,34 +865,374 @@ private:
 
         VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
+        // Vertex Input; the triangle is hardcoded in shader.vert
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexBindingDescriptionCount = 0;
+        vertexInputInfo.vertexAttributeDescriptionCount = 0;
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        // Viewport and Scissor; the window is not resizable
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(swapChainExtent.width);
+        viewport.height = static_cast<float>(swapChainExtent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+
+        VkRect2D scissor{};
+        scissor.offset = { 0, 0 };
+        scissor.extent = swapChainExtent;
+
+        VkPipelineViewportStateCreateInfo viewportState{};
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.pViewports = &viewport;
+        viewportState.scissorCount = 1;
+        viewportState.pScissors = &scissor;
+
+        // Rasterizer
+        VkPipelineRasterizationStateCreateInfo rasterizer{};
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.depthClampEnable = VK_FALSE;
+        rasterizer.rasterizerDiscardEnable = VK_FALSE;
+        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.lineWidth = 1.0f;
+        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+        rasterizer.depthBiasEnable = VK_FALSE;
+
+        VkPipelineMultisampleStateCreateInfo multisampling{};
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.sampleShadingEnable = VK_FALSE;
+        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+        // Color Blending
+        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachment.blendEnable = VK_FALSE;
+
+        VkPipelineColorBlendStateCreateInfo colorBlending{};
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.logicOpEnable = VK_FALSE;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments = &colorBlendAttachment;
+
+        // Pipeline Layout
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 0;
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+
+        VkResult result = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = 2;
+        pipelineInfo.pStages = shaderStages;
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.pMultisampleState = &multisampling;
+        pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.renderPass = renderPass;
+        pipelineInfo.subpass = 0;
+
+        result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create graphics pipeline!");
+        }
+
         vkDestroyShaderModule(device, fragShaderModule, nullptr);
         vkDestroyShaderModule(device, vertShaderModule, nullptr);
+
+        shaderBinaries = {};
+    }
+
+    void createFramebuffers() {
+        swapChainFramebuffers.resize(swapChainImageViews.size());
+
+        for (size_t i = 0; i < swapChainImageViews.size(); i++) {
+            VkImageView attachments[] = { swapChainImageViews[i] };
+
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = renderPass;
+            framebufferInfo.attachmentCount = 1;
+            framebufferInfo.pAttachments = attachments;
+            framebufferInfo.width = swapChainExtent.width;
+            framebufferInfo.height = swapChainExtent.height;
+            framebufferInfo.layers = 1;
+
+            VkResult result = vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]);
+            if (result != VK_SUCCESS) {
+                throw std::runtime_error("failed to create framebuffer!");
+            }
+        }
+    }
+
+    void createCommandPool() {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+        VkResult result = vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create command pool!");
+        }
+    }
+
+    void createCommandBuffer() {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkResult result = vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate command buffers!");
+        }
+    }
+
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
+
+        VkClearValue clearColor = { {{ 0.0f, 0.0f, 0.0f, 1.0f }} };
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = renderPass;
+        renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = swapChainExtent;
+        renderPassInfo.clearValueCount = 1;
+        renderPassInfo.pClearValues = &clearColor;
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        vkCmdDraw(commandBuffer, activeScene->vertexCount, 1, 0, 0);
+        vkCmdEndRenderPass(commandBuffer);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
     }
 
 
     void initVulkan() {
-        createInstance();
-        setupDebugMessenger();
-        createSurface();
-        pickPhysicalDevice();
-        createLogicalDevice();
-        createSwapChain();
-        createImageViews();
-        createGraphicsPipeline();
+        timePhase("createInstance", [this] { createInstance(); });
+        timePhase("setupDebugMessenger", [this] { setupDebugMessenger(); });
+        if (!captureMode) {
+            timePhase("createSurface", [this] { createSurface(); });
+        }
+        timePhase("pickPhysicalDevice", [this] { pickPhysicalDevice(); });
+        timePhase("createLogicalDevice", [this] { createLogicalDevice(); });
+        if (captureMode) {
+            timePhase("createOffscreenTarget", [this] { createOffscreenTarget(); });
+        }
+        else {
+            timePhase("createSwapChain", [this] { createSwapChain(); });
+        }
+        timePhase("createImageViews", [this] { createImageViews(); });
+        timePhase("createRenderPass", [this] { createRenderPass(); });
+        // started in run(); rethrows if either file failed to load
+        timePhase("waitForShaders", [this] { shaderBinaries = shaderCode.get(); });
+        timePhase("createGraphicsPipeline", [this] { createGraphicsPipeline(); });
+        timePhase("createFramebuffers", [this] { createFramebuffers(); });
+        timePhase("createCommandPool", [this] { createCommandPool(); });
+        timePhase("createCommandBuffer", [this] { createCommandBuffer(); });
+
+        if (captureMode) {
+            timePhase("createFrameCapture", [this] {
+                frameCapture.init(physicalDevice, device, queueFamilyIndices.graphicsFamily.value(),
+                    swapChainExtent, swapChainImageFormat);
+            });
+        }
+        else {
+            timePhase("createSyncObjects", [this] { createSyncObjects(); });
+        }
+    }
+
+    void createSyncObjects() {
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        // starts signaled so the first frame does not wait on a frame that never ran
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
+            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS ||
+            vkCreateFence(device, &fenceInfo, nullptr, &inFlightFence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create synchronization objects!");
+        }
+    }
+
+    void drawFrame() {
+        VkResult result = vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to wait for previous frame!");
+        }
+        vkResetFences(device, 1, &inFlightFence);
+
+        uint32_t imageIndex;
+        result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+        if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            throw std::runtime_error("failed to acquire swap chain image!");
+        }
+
+        vkResetCommandBuffer(commandBuffer, 0);
+        recordCommandBuffer(commandBuffer, imageIndex);
+
+        VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
+        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+        VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = waitSemaphores;
+        submitInfo.pWaitDstStageMask = waitStages;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = signalSemaphores;
+
+        result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+
+        VkPresentInfoKHR presentInfo{};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = &swapChain;
+        presentInfo.pImageIndices = &imageIndex;
+
+        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            throw std::runtime_error("failed to present swap chain image!");
+        }
+    }
+
+    bool captureFrame() {
+        recordCommandBuffer(commandBuffer, 0);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        VkResult result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+
+        // submission order on the graphics queue puts the copy after the draw
+        if (!frameCapture.capture(graphicsQueue, offscreenImage,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)) {
+            throw std::runtime_error("failed to start frame capture!");
+        }
+
+        // a one-shot capture has no frame to keep moving, so it blocks on the readback
+        CapturedImage image = frameCapture.wait();
+        reportFirstFrame();
+
+        // file and comparison errors fail the run but still let cleanup() release the device
+        try {
+            if (!capturePath.empty()) {
+                writePng(capturePath, image);
+                std::cout << "captured frame: " << capturePath << std::endl;
+            }
+
+            if (!goldenPath.empty()) {
+                ImageDiff diff = compareImages(image, readPng(goldenPath), captureTolerance);
+                std::cout << "golden image: " << goldenPath << '\n';
+                std::cout << '\t' << "mismatched pixels: " << diff.mismatchedPixels
+                    << " (allowed " << captureMaxMismatch << ")" << '\n';
+                std::cout << '\t' << "max channel delta: " << diff.maxChannelDelta << std::endl;
+
+                if (diff.mismatchedPixels > captureMaxMismatch) {
+                    std::cerr << "captured frame does not match golden image!" << std::endl;
+                    return false;
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
+
+        return true;
     }
 
     void mainLoop() {
+        bool firstFrame = true;
         while (!glfwWindowShouldClose(window)) {
             glfwPollEvents();
+            drawFrame();
+
+            // waits once for the first frame's fence so the metric ends when it has rendered
+            if (firstFrame) {
+                if (vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to wait for first frame!");
+                }
+                reportFirstFrame();
+                firstFrame = false;
+            }
         }
     }
 
     void cleanup() {
+        vkDeviceWaitIdle(device);
+
+        frameCapture.cleanup();
+
+        vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
+        vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
+        vkDestroyFence(device, inFlightFence, nullptr);
+
+        vkDestroyCommandPool(device, commandPool, nullptr);
+
+        for (auto framebuffer : swapChainFramebuffers) {
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+        }
+
+        vkDestroyPipeline(device, graphicsPipeline, nullptr);
+        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        vkDestroyRenderPass(device, renderPass, nullptr);
+
         for (auto imageView : swapChainImageViews) {
             vkDestroyImageView(device, imageView, nullptr);
         }
 
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
+        // capture mode never enables VK_KHR_swapchain
+        if (swapChain != VK_NULL_HANDLE) {
+            vkDestroySwapchainKHR(device, swapChain, nullptr);
+        }
+
+        vkDestroyImage(device, offscreenImage, nullptr);
+        vkFreeMemory(device, offscreenImageMemory, nullptr);
 
         vkDestroyDevice(device, nullptr);
 
@@ -671,26 +1240,107 @@ private:
             DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
         }
 
-        vkDestroySurfaceKHR(instance, surface, nullptr);
+        // capture mode never enables VK_KHR_surface
+        if (surface != VK_NULL_HANDLE) {
+            vkDestroySurfaceKHR(instance, surface, nullptr);
+        }
 
         vkDestroyInstance(instance, nullptr);
 
-        glfwDestroyWindow(window);
+        if (window != nullptr) {
+            glfwDestroyWindow(window);
+        }
 
         glfwTerminate();
     }
 };
 
-int main() {
+static bool parseUnsigned(const char* text, uint64_t& value) {
+    if (!isdigit(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+
+    char* end;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE) {
+        return false;
+    }
+
+    value = parsed;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+
+        bool takesValue =
+            strcmp(option, "--scene") == 0 ||
+            strcmp(option, "--capture") == 0 ||
+            strcmp(option, "--golden") == 0 ||
+            strcmp(option, "--tolerance") == 0 ||
+            strcmp(option, "--max-mismatch") == 0;
+        if (takesValue && i + 1 >= argc) {
+            std::cerr << "missing value for " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(option, "-v") == 0 || strcmp(option, "--verbose") == 0) {
+            verbose = true;
+        }
+        else if (strcmp(option, "--list-scenes") == 0) {
+            for (const auto& scene : scenes) {
+                std::cout << scene.name << '\n';
+            }
+            return EXIT_SUCCESS;
+        }
+        else if (strcmp(option, "--scene") == 0) {
+            const char* name = argv[++i];
+            auto found = std::find_if(scenes.begin(), scenes.end(),
+                [name](const Scene& scene) { return strcmp(scene.name, name) == 0; });
+            if (found == scenes.end()) {
+                std::cerr << "unknown scene: " << name << std::endl;
+                return EXIT_FAILURE;
+            }
+            activeScene = &*found;
+        }
+        else if (strcmp(option, "--capture") == 0) {
+            capturePath = argv[++i];
+        }
+        else if (strcmp(option, "--golden") == 0) {
+            goldenPath = argv[++i];
+        }
+        else if (strcmp(option, "--tolerance") == 0) {
+            uint64_t value;
+            if (!parseUnsigned(argv[++i], value) || value > 255) {
+                std::cerr << "invalid --tolerance (expected 0-255): " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+            captureTolerance = static_cast<uint32_t>(value);
+        }
+        else if (strcmp(option, "--max-mismatch") == 0) {
+            if (!parseUnsigned(argv[++i], captureMaxMismatch)) {
+                std::cerr << "invalid --max-mismatch (expected a pixel count): " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else {
+            std::cerr << "unknown option: " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // --golden alone still renders and compares a frame, it just does not write one
+    captureMode = !capturePath.empty() || !goldenPath.empty();
+
     HelloTriangleApplication app;
 
     try {
-        app.run();
+        return app.run();
     }
     catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;
     }
-
-    return EXIT_SUCCESS;
 }
\ No newline at end of file